@@ -2,11 +2,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "macros.h"
 #include "file_reader.h"
 #include "lexer.h"
+#include "alloc.h"
 
 FileLine* file_as_lines     = NULL;
 Token* line_as_tokens       = NULL;
@@ -23,6 +25,8 @@ void safeFreeAll() {
 
     /* lexer.c */
     safeFree(line_as_tokens);
+
+    /* alloc.c returns its slabs at exit, including anything a failed compile left half-built */
 }
 
 int safeExit(const int exit_code) {
@@ -30,13 +34,37 @@ int safeExit(const int exit_code) {
     exit(exit_code);
 }
 
+static size_t parseMemoryBudget(const char* s) {
+    size_t bytes = 0;
+    if (!parseByteSize(s, &bytes))
+        NOTICE_EXIT("RuntimeError", "Invalid Argument", "`%s` is not a valid memory size - expected a positive size like `4096`, `512K`, `64M` or `1G`", s);
+    return bytes;
+}
+
 int main(int argc, char** argv) {
     printf("macc starting up...\n");
 
     if (argc == 1) NOTICE_EXIT("RuntimeError", "No Compiler Arguments", "Compiler cannot evaluate zero arguments");
 
-    file_as_lines = (FileLine*)malloc(sizeof(FileLine)*MAX_LINES_IN_FILE);
-    const size_t num_lines = readFileAsLines(argv[1], &file_as_lines);
+    const char* file_name = NULL;
+    for (int i = 1; i<argc; i++) {
+        if (strncmp(argv[i], "--max-memory=", 13) == 0) {
+            setMemoryBudget(parseMemoryBudget(argv[i] + 13));
+            continue;
+        }
+        if (strcmp(argv[i], "--max-memory") == 0) {
+            if (i+1 >= argc) NOTICE_EXIT("RuntimeError", "Invalid Argument", "`--max-memory` expects a size, e.g. `--max-memory 64M`");
+            setMemoryBudget(parseMemoryBudget(argv[++i]));
+            continue;
+        }
+        if (argv[i][0] == '-') NOTICE_EXIT("RuntimeError", "Unknown Option", "`%s` is not a recognized option", argv[i]);
+        if (file_name) NOTICE_EXIT("RuntimeError", "Too Many Files", "Compiler takes one input file but got `%s` and `%s`", file_name, argv[i]);
+        file_name = argv[i];
+    }
+    if (!file_name) NOTICE_EXIT("RuntimeError", "No Input File", "Compiler needs a file to compile");
+
+    file_as_lines = (FileLine*)poolAlloc(AP_Reader, sizeof(FileLine)*MAX_LINES_IN_FILE);
+    const size_t num_lines = readFileAsLines(file_name, &file_as_lines);
     printf_dbg("\n");
 
     const LexNode master_node = buildLexTree(file_as_lines, num_lines);
@@ -44,6 +72,10 @@ int main(int argc, char** argv) {
     deleteLexTree(master_node);
 
     safeFreeAll();
+
+    /* Only clean exits report leaks - error exits abandon whatever was half-built */
+    if (debug_flag) printAllocReport();
+    reportLeaks();
     
     printf("All done.\n");
     return EXIT_SUCCESS;
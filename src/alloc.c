@@ -0,0 +1,232 @@
+#include "alloc.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "macros.h"
+#include "safe.h"
+#include "debug.h"
+
+#define ALLOC_SLAB_BLOCKS 16
+
+/* Every block is prefixed with a header so poolFree knows which pool to credit and by how much */
+typedef union alloc_header_u {
+    struct {
+        size_t size;
+        enum AllocPool pool;
+        bool is_slab_block;
+        union alloc_header_u* next_free;
+    } info;
+    max_align_t align;
+} AllocHeader;
+
+/* Slabs carve ALLOC_SLAB_BLOCKS same-sized blocks out of one backend allocation */
+typedef union slab_header_u {
+    union slab_header_u* next;
+    max_align_t align;
+} SlabHeader;
+
+typedef struct pool_s {
+    size_t live_bytes, peak_bytes;
+    size_t block_size;          /* Size this pool's slabs were carved for, 0 before the first slab */
+    AllocHeader* free_blocks;
+    SlabHeader* slabs;
+} Pool;
+
+/* Pools that allocate many same-sized blocks per compile get slabs and a free list */
+static const bool pool_uses_slabs[NUM_ALLOC_POOLS] = {
+    [AP_Tree] = true
+};
+
+static Allocator current_allocator = { .alloc = malloc, .free = free };
+static size_t memory_budget = 0;
+
+static Pool pools[NUM_ALLOC_POOLS] = {0};
+static size_t total_live_bytes = 0;
+static size_t total_peak_bytes = 0;
+static size_t reserved_bytes = 0;      /* Everything held from the backend, headers and cached slabs included */
+static size_t peak_reserved_bytes = 0;
+static bool is_release_registered = false;
+
+void setAllocator(const Allocator allocator) {
+    assert(allocator.alloc);
+    assert(allocator.free);
+    assert(reserved_bytes == 0); /* Blocks must be freed by the allocator that made them */
+    current_allocator = allocator;
+}
+
+void setMemoryBudget(const size_t max_bytes) {
+    printf_dbg("Memory budget set to %zu bytes\n", max_bytes);
+    memory_budget = max_bytes;
+}
+
+/* Parses sizes like `4096`, `512K`, `64M` or `1G`. Zero is rejected since it would mean no budget at all. */
+bool parseByteSize(const char* s, size_t* bytes) {
+    assert(s); assert(bytes);
+    if (!isdigit((unsigned char)s[0])) return false;
+
+    errno = 0;
+    char* end = NULL;
+    const unsigned long long value = strtoull(s, &end, 10);
+    if (errno == ERANGE || value > SIZE_MAX || value == 0) return false;
+
+    size_t shift = 0;
+    switch (*end) {
+        case 'K': case 'k': shift = 10; end++; break;
+        case 'M': case 'm': shift = 20; end++; break;
+        case 'G': case 'g': shift = 30; end++; break;
+        default: break;
+    }
+    if (*end) return false;
+    if (value > (SIZE_MAX >> shift)) return false;
+
+    *bytes = (size_t)value << shift;
+    return true;
+}
+
+static void* reserveBytes(const enum AllocPool pool, const size_t size) {
+    const bool is_over_budget = memory_budget && reserved_bytes + size > memory_budget;
+    void* ptr = is_over_budget ? NULL : current_allocator.alloc(size);
+
+    if (!ptr) {
+        /* Whatever was lexed last did not cause this, so keep it out of the diagnostic */
+        DebugLastFileLine = NULL;
+        DebugLastToken    = NULL;
+        if (is_over_budget)
+            NOTICE_EXIT_CODE(ERROR_OUT_OF_MEMORY, "RuntimeError", "MemoryBudgetExceeded",
+                "Reserving %zu bytes for the %s pool would exceed the memory budget (%zu of %zu bytes in use).",
+                size, strAllocPool(pool), reserved_bytes, memory_budget);
+        NOTICE_EXIT_CODE(ERROR_OUT_OF_MEMORY, "RuntimeError", "OutOfMemory",
+            "Failed to reserve %zu bytes for the %s pool.", size, strAllocPool(pool));
+    }
+
+    reserved_bytes += size;
+    if (reserved_bytes > peak_reserved_bytes) peak_reserved_bytes = reserved_bytes;
+    return ptr;
+}
+
+static void releaseBytes(void* ptr, const size_t size) {
+    reserved_bytes -= size;
+    current_allocator.free(ptr);
+}
+
+static size_t slabBlockStride(const size_t size) {
+    const size_t align = sizeof(max_align_t);
+    return sizeof(AllocHeader) + (size + align - 1) / align * align;
+}
+
+/* Runs at exit only: any block still live in a slab is freed with it, which is safe once nothing else runs */
+static void releasePools() {
+    for (size_t i = 0; i<NUM_ALLOC_POOLS; i++) {
+        Pool* p = &pools[i];
+        const size_t slab_bytes = sizeof(SlabHeader) + slabBlockStride(p->block_size) * ALLOC_SLAB_BLOCKS;
+        while (p->slabs) {
+            SlabHeader* next = p->slabs->next;
+            releaseBytes(p->slabs, slab_bytes);
+            p->slabs = next;
+        }
+        p->free_blocks = NULL;
+        p->block_size  = 0;
+    }
+}
+
+static void growSlab(const enum AllocPool pool, const size_t size) {
+    const size_t stride = slabBlockStride(size);
+    SlabHeader* slab = (SlabHeader*)reserveBytes(pool, sizeof(SlabHeader) + stride * ALLOC_SLAB_BLOCKS);
+    if (!is_release_registered) is_release_registered = (atexit(releasePools) == 0);
+    printf_dbg("Growing the %s pool by %d blocks of %zu bytes\n", strAllocPool(pool), ALLOC_SLAB_BLOCKS, size);
+
+    slab->next = pools[pool].slabs;
+    pools[pool].slabs = slab;
+    pools[pool].block_size = size;
+
+    char* blocks = (char*)(slab + 1);
+    for (size_t i = 0; i<ALLOC_SLAB_BLOCKS; i++) {
+        AllocHeader* header = (AllocHeader*)(blocks + i*stride);
+        header->info.pool = pool;
+        header->info.is_slab_block = true;
+        header->info.next_free = pools[pool].free_blocks;
+        pools[pool].free_blocks = header;
+    }
+}
+
+void* poolAlloc(const enum AllocPool pool, const size_t size) {
+    assert(pool < NUM_ALLOC_POOLS);
+    Pool* p = &pools[pool];
+
+    AllocHeader* header = NULL;
+    if (pool_uses_slabs[pool] && (p->block_size == 0 || p->block_size == size)) {
+        if (!p->free_blocks) growSlab(pool, size);
+        header = p->free_blocks;
+        p->free_blocks = header->info.next_free;
+    } else {
+        header = (AllocHeader*)reserveBytes(pool, sizeof(AllocHeader) + size);
+        header->info.pool = pool;
+        header->info.is_slab_block = false;
+    }
+    header->info.size = size;
+
+    p->live_bytes    += size;
+    total_live_bytes += size;
+    if (p->live_bytes > p->peak_bytes) p->peak_bytes = p->live_bytes;
+    if (total_live_bytes > total_peak_bytes) total_peak_bytes = total_live_bytes;
+
+    return header + 1;
+}
+
+void poolFree(void* ptr) {
+    if (!ptr) return;
+
+    AllocHeader* header = (AllocHeader*)ptr - 1;
+    const enum AllocPool pool = header->info.pool;
+    assert(pool < NUM_ALLOC_POOLS);
+    Pool* p = &pools[pool];
+    assert(p->live_bytes >= header->info.size);
+
+    p->live_bytes    -= header->info.size;
+    total_live_bytes -= header->info.size;
+
+    if (header->info.is_slab_block) {
+        header->info.next_free = p->free_blocks;
+        p->free_blocks = header;
+        return;
+    }
+    releaseBytes(header, sizeof(AllocHeader) + header->info.size);
+}
+
+size_t poolLiveBytes(const enum AllocPool pool) { return pools[pool].live_bytes; }
+size_t poolPeakBytes(const enum AllocPool pool) { return pools[pool].peak_bytes; }
+size_t totalLiveBytes() { return total_live_bytes; }
+size_t totalPeakBytes() { return total_peak_bytes; }
+size_t reservedBytes()  { return reserved_bytes; }
+
+const char* strAllocPool(const enum AllocPool pool) {
+    switch (pool) {
+        case AP_Reader: return "reader";
+        case AP_Lexer:  return "lexer";
+        case AP_Tree:   return "tree";
+        default: break;
+    }
+    return "(unknown)";
+}
+
+void printAllocReport() {
+    printf("%-12s %12s %12s\n", "Pool", "Live", "Peak");
+    for (size_t i = 0; i<NUM_ALLOC_POOLS; i++)
+        printf("%-12s %12zu %12zu\n", strAllocPool(i), pools[i].live_bytes, pools[i].peak_bytes);
+    printf("%-12s %12zu %12zu\n", "total", total_live_bytes, total_peak_bytes);
+    printf("%-12s %12zu %12zu\n", "reserved", reserved_bytes, peak_reserved_bytes);
+}
+
+bool reportLeaks() {
+    if (total_live_bytes == 0) return false;
+
+    printf("\n[RuntimeWarning - MemoryLeak]\n");
+    for (size_t i = 0; i<NUM_ALLOC_POOLS; i++)
+        if (pools[i].live_bytes) printf("%zu bytes still live in the %s pool\n", pools[i].live_bytes, strAllocPool(i));
+    return true;
+}
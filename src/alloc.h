@@ -0,0 +1,39 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+enum AllocPool {
+    AP_Reader,
+    AP_Lexer,
+    AP_Tree,
+
+    NUM_ALLOC_POOLS
+};
+
+typedef struct allocator_s {
+    void* (*alloc)(size_t size);
+    void  (*free )(void* ptr);
+} Allocator;
+
+void setAllocator(const Allocator allocator);
+void setMemoryBudget(const size_t max_bytes); /* 0 means unlimited */
+bool parseByteSize(const char* s, size_t* bytes);
+
+/* Slab-backed pools keep their slabs until exit, when they are returned to the backend */
+void* poolAlloc(const enum AllocPool pool, const size_t size);
+void  poolFree(void* ptr);
+
+size_t poolLiveBytes(const enum AllocPool pool);
+size_t poolPeakBytes(const enum AllocPool pool);
+size_t totalLiveBytes();
+size_t totalPeakBytes();
+size_t reservedBytes();
+
+const char* strAllocPool(const enum AllocPool pool);
+void printAllocReport();
+bool reportLeaks();
+
+#endif /* ALLOC_H */
@@ -37,13 +37,8 @@ FIND_OF_CHAR_W_BOOL_W_HITS(findFirstNotOf , false, 1)
 FIND_OF_CHAR_W_BOOL_W_HITS(findSecondNotOf, false, 2)
 
 static void lstrip(char* s, const size_t len) {
-    char* t_src = (char*)malloc(sizeof(char)*len);
-    char* t = t_src;
-    strncpy(t, s, len);
-    const size_t first_not_of_space = findFirstNotOf(t, MAX_LINE_BUF_SZ, ' ');
-    if (first_not_of_space > 0) t += first_not_of_space;
-    strncpy(s, t, len);
-    free(t_src);
+    const ssize_t first_not_of_space = findFirstNotOf(s, len, ' ');
+    if (first_not_of_space > 0) memmove(s, s + first_not_of_space, len - first_not_of_space);
 }
 
 bool isEmptyFileLine(const FileLine fl) {
@@ -54,17 +49,16 @@ bool isEmptyFileLine(const FileLine fl) {
 
 const char* strFileLine(const FileLine fl) {
     static char buf[MAX_STR_FILELINE_SZ];
-    char* stripped = (char*)malloc(sizeof(char)*MAX_LINE_BUF_SZ);
+    char stripped[MAX_LINE_BUF_SZ];
     strncpy(stripped, fl.line_buf, MAX_LINE_BUF_SZ);
     lstrip(stripped, MAX_LINE_BUF_SZ);
     snprintf(buf, MAX_STR_FILELINE_SZ, "%s:%zu: %s", fl.file_name, fl.line_number, stripped);
-    free(stripped);
     return buf;
 }
 bool copyFileLine(FileLine* a, const FileLine b) {
     assert(a);
     a->line_number = b.line_number;
-    memcpy(a->line_buf, b.line_buf, MAX_FILE_NAME_SZ);
+    memcpy(a->line_buf, b.line_buf, MAX_LINE_BUF_SZ);
     memcpy(a->file_name, b.file_name, MAX_FILE_NAME_SZ);
     return true;
 }
@@ -73,8 +67,7 @@ bool copyFileLine(FileLine* a, const FileLine b) {
 static size_t sanitizeLine(char** line_buf) {
     printf_dbg("Sanitizing Line `%s`\n", *line_buf);
 
-    char* new_buf = (char*)malloc(sizeof(char)*MAX_LINE_BUF_SZ);
-    char* temp = new_buf;
+    char temp[MAX_LINE_BUF_SZ];
     memcpy(temp, *line_buf, MAX_LINE_BUF_SZ);
 
     /* Ignore preprocessor commands */
@@ -104,24 +97,33 @@ static size_t sanitizeLine(char** line_buf) {
 
 END:
     strncpy(*line_buf, temp, MAX_LINE_BUF_SZ);
-    free(new_buf);
 
     return strlen(*line_buf);
 }
 
+/* Lines longer than MAX_LINE_BUF_SZ are truncated, so the rest of such a line is discarded */
+static bool readRawLine(FILE* in_file, char line_buf[MAX_LINE_BUF_SZ]) {
+    if (!fgets(line_buf, MAX_LINE_BUF_SZ, in_file)) return false;
+    if (!strchr(line_buf, '\n')) {
+        int c;
+        while ((c = fgetc(in_file)) != EOF && c != '\n');
+    }
+    return true;
+}
+
 size_t readFileAsLines(const char file_name[MAX_FILE_NAME_SZ], FileLine** file_as_lines) {
     printf_dbg("Reading file `%s` as lines...\n", file_name);
     FILE* in_file = fopen(file_name, "r");
     if (!in_file) NOTICE_EXIT("RuntimeError", "File Not Found", "File with name `%s` could not be found", file_name);
 
-    size_t len = MAX_LINE_BUF_SZ;
-    char* line_buf = (char*)malloc(sizeof(char)*len);
+    char line_buf[MAX_LINE_BUF_SZ] = {0};
+    char* line_ptr = line_buf;
     size_t line_number = 0;
     size_t num_lines = 0;
 
-    while (getline(&line_buf, &len, in_file) != -1) {
+    while (readRawLine(in_file, line_buf)) {
         line_number++;
-        size_t sanitized_len = sanitizeLine(&line_buf);
+        size_t sanitized_len = sanitizeLine(&line_ptr);
         if (sanitized_len == 0) continue;
 
         FileLine fl = newFileLine(line_number, line_buf, file_name);
@@ -130,8 +132,126 @@ size_t readFileAsLines(const char file_name[MAX_FILE_NAME_SZ], FileLine** file_a
         copyFileLine(&(*file_as_lines)[num_lines++], fl);
     }
 
-    free(line_buf);
     fclose(in_file);
 
     return num_lines;
 }
+
+/******************************************/
+
+static void setSourceLine(SourceFile* source, const size_t index, const char* raw, const size_t len) {
+    char* raw_line = source->raw_lines[index];
+    const size_t copy_len = (len < MAX_LINE_BUF_SZ-1) ? len : MAX_LINE_BUF_SZ-1;
+    memset(raw_line, 0, MAX_LINE_BUF_SZ);
+    memcpy(raw_line, raw, copy_len);
+
+    /* Run the same cleanup readFileAsLines does so the line matches a fresh read */
+    char sanitized[MAX_LINE_BUF_SZ];
+    char* sanitized_ptr = sanitized;
+    memcpy(sanitized, raw_line, MAX_LINE_BUF_SZ);
+    sanitizeLine(&sanitized_ptr);
+    source->lines[index] = newFileLine(index+1, sanitized, source->file_name);
+}
+
+bool loadSourceFile(SourceFile* source, const char file_name[MAX_FILE_NAME_SZ], const char* text) {
+    assert(source); assert(text);
+
+    source->num_lines = 0;
+    strncpy(source->file_name, file_name, MAX_FILE_NAME_SZ-1);
+    source->file_name[MAX_FILE_NAME_SZ-1] = 0;
+
+    const char* line_start = text;
+    while (true) {
+        if (source->num_lines >= MAX_LINES_IN_FILE) {
+            NOTICE("RuntimeWarning", "FileTooLong", "`%s` has more than %d lines.", file_name, MAX_LINES_IN_FILE);
+            return false;
+        }
+        const char* line_end = strchr(line_start, '\n');
+        const size_t len = line_end ? (size_t)(line_end - line_start) : strlen(line_start);
+        setSourceLine(source, source->num_lines++, line_start, len);
+        if (!line_end) break;
+        line_start = line_end + 1;
+    }
+    return true;
+}
+
+SourceEdit newSourceEdit(const size_t start_line, const size_t start_column, const size_t end_line, const size_t end_column, const char* text) {
+    SourceEdit edit = {
+        .start = { .line = start_line, .column = start_column },
+        .end   = { .line = end_line  , .column = end_column   },
+        .text     = text,
+        .text_len = strlen(text)
+    };
+    return edit;
+}
+
+bool applySourceEdit(SourceFile* source, const SourceEdit edit, size_t* first_line, size_t* num_removed, size_t* num_added) {
+    assert(source);
+    const SourcePos start = edit.start, end = edit.end;
+
+    if (end.line >= source->num_lines || start.line > end.line ||
+        (start.line == end.line && start.column > end.column) ||
+        start.column > strlen(source->raw_lines[start.line]) ||
+        end.column   > strlen(source->raw_lines[end.line])) {
+        DebugLastFileLine = NULL;
+        NOTICE("RuntimeWarning", "InvalidSourceEdit", "Edit range %zu:%zu-%zu:%zu is outside of `%s`. It will be ignored.",
+            start.line, start.column, end.line, end.column, source->file_name);
+        return false;
+    }
+    DebugLastFileLine = &(source->lines[start.line]);
+
+    const char* end_raw = source->raw_lines[end.line];
+    const size_t suffix_len = strlen(end_raw) - end.column;
+
+    /* Count the lines the edit leaves behind and make sure none of them overflows */
+    const size_t removed = end.line - start.line + 1;
+    size_t added = 1, line_len = start.column;
+    for (size_t i = 0; i<edit.text_len; i++) {
+        if (edit.text[i] == '\n') { added++; line_len = 0; continue; }
+        if (++line_len >= MAX_LINE_BUF_SZ) break; /* Leaves line_len too long for the check below */
+    }
+    if (line_len + suffix_len >= MAX_LINE_BUF_SZ) {
+        NOTICE("RuntimeWarning", "InvalidSourceEdit", "Edit would make a line longer than %d chars. It will be ignored.", MAX_LINE_BUF_SZ-1);
+        return false;
+    }
+    if (source->num_lines - removed + added > MAX_LINES_IN_FILE) {
+        NOTICE("RuntimeWarning", "InvalidSourceEdit", "Edit would grow `%s` past %d lines. It will be ignored.", source->file_name, MAX_LINES_IN_FILE);
+        return false;
+    }
+
+    /* The first and last lines keep text from outside the edit, so copy it out before any lines move */
+    char prefix[MAX_LINE_BUF_SZ], suffix[MAX_LINE_BUF_SZ];
+    memcpy(prefix, source->raw_lines[start.line], start.column);
+    memcpy(suffix, end_raw + end.column, suffix_len);
+
+    /* If the line count changed, move the lines after the edit into place and renumber them */
+    if (added != removed) {
+        const size_t tail = source->num_lines - (end.line + 1);
+        memmove(source->raw_lines[start.line + added], source->raw_lines[end.line + 1], tail * MAX_LINE_BUF_SZ);
+        memmove(&(source->lines[start.line + added]), &(source->lines[end.line + 1]), tail * sizeof(FileLine));
+        source->num_lines = source->num_lines - removed + added;
+        for (size_t i = start.line + added; i<source->num_lines; i++)
+            source->lines[i].line_number = i+1;
+    }
+
+    const char* text = edit.text;
+    const char* text_end = edit.text + edit.text_len;
+    for (size_t i = 0; i<added; i++) {
+        const char* text_line_end = memchr(text, '\n', text_end - text);
+        const size_t text_part_len = text_line_end ? (size_t)(text_line_end - text) : (size_t)(text_end - text);
+
+        char line[MAX_LINE_BUF_SZ];
+        size_t len = 0;
+        if (i == 0) { memcpy(line, prefix, start.column); len = start.column; }
+        memcpy(line + len, text, text_part_len); len += text_part_len;
+        if (i == added-1) { memcpy(line + len, suffix, suffix_len); len += suffix_len; }
+        setSourceLine(source, start.line + i, line, len);
+
+        if (text_line_end) text = text_line_end + 1;
+    }
+
+    if (first_line ) *first_line  = start.line;
+    if (num_removed) *num_removed = removed;
+    if (num_added  ) *num_added   = added;
+    return true;
+}
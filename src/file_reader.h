@@ -33,6 +33,32 @@ bool isEmptyFileLine(const FileLine fl);
 
 size_t readFileAsLines(const char file_name[MAX_FILE_NAME_SZ], FileLine** file_as_lines);
 
+/******************************************/
+
+/* Editor view of a file: every raw line is kept, including blank, comment and preproc lines.
+ * lines[i] is raw_lines[i] after sanitizing, so it may be empty, and its line_number is i+1.
+ * Passing lines straight to buildLexTree gives the same tree as readFileAsLines would. */
+typedef struct source_file_s {
+    size_t num_lines;
+    char file_name[MAX_FILE_NAME_SZ];
+    char raw_lines[MAX_LINES_IN_FILE][MAX_LINE_BUF_SZ]; /* Without the trailing newline */
+    FileLine lines[MAX_LINES_IN_FILE];
+} SourceFile;
+
+typedef struct source_pos_s {
+    size_t line, column; /* Both 0-based, column is a byte offset into the raw line */
+} SourcePos;
+
+typedef struct source_edit_s {
+    SourcePos start, end;   /* Replaces the raw text in [start, end), which may span lines */
+    const char* text;       /* Not copied, so it must outlive the edit. May contain newlines, so Enter/Backspace split and join lines */
+    size_t text_len;
+} SourceEdit;
+
+bool loadSourceFile(SourceFile* source, const char file_name[MAX_FILE_NAME_SZ], const char* text);
+SourceEdit newSourceEdit(const size_t start_line, const size_t start_column, const size_t end_line, const size_t end_column, const char* text);
+bool applySourceEdit(SourceFile* source, const SourceEdit edit, size_t* first_line, size_t* num_removed, size_t* num_added);
+
 static inline bool isSpace(const char c) {
     return (
         c == ' '  ||
@@ -214,8 +214,9 @@ size_t tokenizeFileLine(const FileLine parent_line, Token** tokens) {
 /******************************************/
 
 LexNode newLexNode(const Token tokens[MAX_TOKENS_IN_LINE], const size_t num_tokens) {
-    LexNode node = (LexNode)malloc(sizeof(struct lex_node_s));
+    LexNode node = (LexNode)poolAlloc(AP_Tree, sizeof(struct lex_node_s));
 
+    node->num_tokens   = num_tokens;
     node->num_children = 0;
     memcpy(node->tokens, tokens, sizeof(Token) * num_tokens);
     
@@ -235,7 +236,7 @@ bool deleteLexTree(LexNode node) {
         deleteLexTree(node->children[i]);
 
     safeFree(node);
-    printf("Successfully deleted 1 LexNode\n");
+    printf_dbg("Successfully deleted 1 LexNode\n");
     return true;
 }
 
@@ -290,27 +291,14 @@ static enum LexNodeType getNodeType(const Token tokens[MAX_TOKENS_IN_LINE], cons
 }
 
 extern Token* line_as_tokens;
-const LexNode buildLexTree(FileLine file_as_lines[MAX_LINES_IN_FILE], const size_t num_lines) {
-    assert(num_lines > 0);
 
-    line_as_tokens = (Token*)malloc(sizeof(Token)*MAX_TOKENS_IN_LINE);
-    for (size_t i = 0; i<num_lines; i++) {
-        DebugLastFileLine = &(file_as_lines[i]);
-        if (isEmptyFileLine(file_as_lines[i])) continue;
+/* Lexes file_as_lines[first..last] into current_node's scope, exactly as buildLexTree does.
+ * Returns the scope left open afterwards, or NULL if a `}` closes past the top of the tree
+ * or closes back out to `outer` before `last`. */
+static LexNode lexLines(LexNode current_node, FileLine file_as_lines[MAX_LINES_IN_FILE], const size_t first, const size_t last, const LexNode outer) {
+    if (!line_as_tokens) line_as_tokens = (Token*)poolAlloc(AP_Lexer, sizeof(Token)*MAX_TOKENS_IN_LINE);
 
-        printf_dbg("%s\n", strFileLine(file_as_lines[i]));
-        const size_t num_tokens = tokenizeFileLine(file_as_lines[i], &line_as_tokens);
-
-        for (size_t j = 0; j<num_tokens; j++) {
-            printf_dbg(" * %s\n", strToken(line_as_tokens[j]));
-        } printf_dbg("\n");
-    }
-    printf_dbg("\n");
-
-
-    LexNode master_node = newMasterLexNode(file_as_lines[0].file_name);
-    LexNode current_node = master_node;
-    for (size_t i = 0; i<num_lines; i++) {
+    for (size_t i = first; i<=last; i++) {
         DebugLastFileLine = &(file_as_lines[i]);
 
         // FIXME: Should really use a tokens buffer so we can support any bracket variant
@@ -328,10 +316,9 @@ const LexNode buildLexTree(FileLine file_as_lines[MAX_LINES_IN_FILE], const size
                 break;
 
             case LNT_Close:
-                if (!current_node->parent)
-                    NOTICE_EXIT_CODE(ERROR_MISMATCHED_BRACES, "SyntaxError",
-                        "MismatchedBraces", "Possible mismatched braces. Please check.");
+                if (!current_node->parent) return NULL;
                 current_node = current_node->parent;
+                if (current_node == outer && i != last) return NULL;
                 break;
 
             case LNT_Stay:
@@ -343,5 +330,209 @@ const LexNode buildLexTree(FileLine file_as_lines[MAX_LINES_IN_FILE], const size
         }
     }
 
+    return current_node;
+}
+
+const LexNode buildLexTree(FileLine file_as_lines[MAX_LINES_IN_FILE], const size_t num_lines) {
+    assert(num_lines > 0);
+
+    if (!line_as_tokens) line_as_tokens = (Token*)poolAlloc(AP_Lexer, sizeof(Token)*MAX_TOKENS_IN_LINE);
+    for (size_t i = 0; i<num_lines; i++) {
+        DebugLastFileLine = &(file_as_lines[i]);
+        if (isEmptyFileLine(file_as_lines[i])) continue;
+
+        printf_dbg("%s\n", strFileLine(file_as_lines[i]));
+        const size_t num_tokens = tokenizeFileLine(file_as_lines[i], &line_as_tokens);
+
+        for (size_t j = 0; j<num_tokens; j++) {
+            printf_dbg(" * %s\n", strToken(line_as_tokens[j]));
+        } printf_dbg("\n");
+    }
+    printf_dbg("\n");
+
+
+    LexNode master_node = newMasterLexNode(file_as_lines[0].file_name);
+    if (!lexLines(master_node, file_as_lines, 0, num_lines-1, NULL))
+        NOTICE_EXIT_CODE(ERROR_MISMATCHED_BRACES, "SyntaxError",
+            "MismatchedBraces", "Possible mismatched braces. Please check.");
+
     return master_node;
-}
\ No newline at end of file
+}
+
+/******************************************/
+
+#define lineIndex(NODE) ((NODE)->tokens[0].parent_line.line_number - 1)
+
+static bool isClosedLexNode(const LexNode node) {
+    if (!node->parent || node->num_children == 0) return false;
+    const LexNode last_child = node->children[node->num_children-1];
+    return getNodeType(last_child->tokens, last_child->num_tokens) == LNT_Close;
+}
+
+/* Index of the last line in node's scope: its closing `}` line, or the end of the file if it never closes */
+static size_t lastLineOfScope(const LexNode node, const size_t num_lines) {
+    if (!isClosedLexNode(node)) return num_lines-1;
+    return lineIndex(node->children[node->num_children-1]);
+}
+
+/* Deepest scope whose body holds every line in [first, last] without its own `{` line being one of them */
+static LexNode findEnclosingScope(LexNode master_node, const size_t first, const size_t last, const size_t num_lines) {
+    LexNode scope = master_node;
+    while (true) {
+        LexNode candidate = NULL;
+        for (size_t i = scope->num_children; i-- > 0; ) {
+            if (lineIndex(scope->children[i]) < first) {
+                candidate = scope->children[i];
+                break;
+            }
+        }
+        if (!candidate) return scope;
+        if (getNodeType(candidate->tokens, candidate->num_tokens) != LNT_Open) return scope;
+        if (lastLineOfScope(candidate, num_lines) < last) return scope;
+        scope = candidate;
+    }
+}
+
+/* Last line a child covers: its own line, or through its closing `}` if it opens a scope */
+static size_t lastLineOfChild(const LexNode child, const size_t num_lines) {
+    if (getNodeType(child->tokens, child->num_tokens) != LNT_Open) return lineIndex(child);
+    return lastLineOfScope(child, num_lines);
+}
+
+static void shiftLexTreeLines(LexNode node, const size_t after, const ssize_t delta) {
+    for (size_t i = 0; i<node->num_children; i++) {
+        LexNode child = node->children[i];
+        if (lineIndex(child) > after) {
+            for (size_t j = 0; j<child->num_tokens; j++)
+                child->tokens[j].parent_line.line_number += delta;
+        }
+        shiftLexTreeLines(child, after, delta);
+    }
+}
+
+/* Re-lexes the lines between scope->children[keep_before-1] and scope->children[keep_after], which were
+ * [region_first, old_region_last] before the edit, and splices the result in between those kept children.
+ * Fails without touching the tree if the new lines do not leave the braces balanced at this scope. */
+static bool spliceScope(LexNode master_node, LexNode scope, SourceFile* source, const size_t keep_before, const size_t keep_after,
+                        const size_t region_first, const size_t old_region_last, const ssize_t delta) {
+    const size_t region_last = old_region_last + delta;
+    assert(region_first <= region_last);
+
+    LexNode scratch_node = newLexNode(scope->tokens, scope->num_tokens);
+    scratch_node->parent = scope->parent;
+    const LexNode open_node = lexLines(scratch_node, source->lines, region_first, region_last, scope->parent);
+
+    /* Before a kept sibling the region must end back in this scope, otherwise it must end like the scope did */
+    bool is_balanced;
+    if (keep_after < scope->num_children) is_balanced = (open_node == scratch_node);
+    else if (isClosedLexNode(scope))      is_balanced = (open_node == scope->parent);
+    else                                  is_balanced = (open_node && open_node != scope->parent);
+
+    const size_t num_kept_after = scope->num_children - keep_after;
+    if (!is_balanced || keep_before + scratch_node->num_children + num_kept_after > MAX_NUM_LEX_CHILDREN) {
+        printf_dbg("Edit does not balance within the scope of line %zu -> Widening\n", scope->tokens[0].parent_line.line_number);
+        deleteLexTree(scratch_node);
+        return false;
+    }
+
+    for (size_t i = keep_before; i<keep_after; i++)
+        deleteLexTree(scope->children[i]);
+    memmove(&(scope->children[keep_before]), &(scope->children[keep_after]), sizeof(LexNode) * num_kept_after);
+    scope->num_children = keep_before + num_kept_after;
+
+    /* Only the old nodes are in the tree here, so everything after the region moves by delta */
+    if (delta) shiftLexTreeLines(master_node, old_region_last, delta);
+
+    memmove(&(scope->children[keep_before + scratch_node->num_children]), &(scope->children[keep_before]), sizeof(LexNode) * num_kept_after);
+    for (size_t i = 0; i<scratch_node->num_children; i++) {
+        scope->children[keep_before + i] = scratch_node->children[i];
+        scope->children[keep_before + i]->parent = scope;
+    }
+    scope->num_children += scratch_node->num_children;
+    safeFree(scratch_node);
+
+    return true;
+}
+
+const LexNode patchLexTree(LexNode master_node, SourceFile* source, const SourceEdit* edits, const size_t num_edits, size_t* num_applied) {
+    assert(source);
+    assert(edits || num_edits == 0);
+
+    /* Merge the edits into one dirty range [first, last] of the edited source */
+    const size_t old_num_lines = source->num_lines;
+    bool is_dirty = false;
+    size_t first = 0, last = 0;
+    size_t e;
+    for (e = 0; e<num_edits; e++) {
+        size_t edit_first, num_removed, num_added;
+        if (!applySourceEdit(source, edits[e], &edit_first, &num_removed, &num_added)) break;
+
+        const size_t edit_old_last = edit_first + num_removed - 1;
+        const size_t edit_new_last = edit_first + num_added   - 1;
+        if (!is_dirty) {
+            first = edit_first;
+            last  = edit_new_last;
+            is_dirty = true;
+            continue;
+        }
+        last  = (last > edit_old_last) ? last + num_added - num_removed : edit_new_last;
+        first = (edit_first < first) ? edit_first : first;
+    }
+    if (num_applied) *num_applied = e;
+
+    if (!master_node) {
+        LexNode new_master_node = newMasterLexNode(source->file_name);
+        if (lexLines(new_master_node, source->lines, 0, source->num_lines-1, NULL)) return new_master_node;
+        deleteLexTree(new_master_node);
+        return NULL;
+    }
+    if (!is_dirty) return master_node;
+
+    /* The tokenizer keeps no state between lines, so only the dirty lines changed. In the smallest
+     * scope around them, re-lex just the children those lines touch and splice them in between
+     * the untouched siblings, widening to the enclosing scope until the braces balance. */
+    const ssize_t delta = (ssize_t)source->num_lines - (ssize_t)old_num_lines;
+    const size_t old_last = last - delta;
+    for (LexNode scope = findEnclosingScope(master_node, first, old_last, old_num_lines); scope; scope = scope->parent) {
+        size_t keep_before = 0;
+        while (keep_before < scope->num_children && lastLineOfChild(scope->children[keep_before], old_num_lines) < first)
+            keep_before++;
+        size_t keep_after = keep_before;
+        while (keep_after < scope->num_children && lineIndex(scope->children[keep_after]) <= old_last)
+            keep_after++;
+
+        const size_t body_first = scope->parent ? lineIndex(scope) + 1 : 0;
+        const size_t old_body_last = lastLineOfScope(scope, old_num_lines);
+        const size_t region_first = keep_before ? lastLineOfChild(scope->children[keep_before-1], old_num_lines) + 1 : body_first;
+        const size_t old_region_last = (keep_after < scope->num_children) ? lineIndex(scope->children[keep_after]) - 1 : old_body_last;
+
+        if (spliceScope(master_node, scope, source, keep_before, keep_after, region_first, old_region_last, delta))
+            return master_node;
+
+        /* An enclosing scope retries this one whole, but the top level has none, so retry it here */
+        const bool is_whole_body = (keep_before == 0 && keep_after == scope->num_children);
+        if (!scope->parent && !is_whole_body &&
+            spliceScope(master_node, scope, source, 0, scope->num_children, body_first, old_body_last, delta))
+            return master_node;
+    }
+
+    return NULL;
+}
+
+bool equalLexTree(const LexNode a, const LexNode b) {
+    if (!a || !b) return a == b;
+    if (a->num_tokens != b->num_tokens || a->num_children != b->num_children) return false;
+
+    for (size_t i = 0; i<a->num_tokens; i++) {
+        const Token ta = a->tokens[i], tb = b->tokens[i];
+        if (ta.space_offset != tb.space_offset) return false;
+        if (strncmp(ta.text, tb.text, MAX_TOKEN_TEXT_SIZE) != 0) return false;
+        if (ta.parent_line.line_number != tb.parent_line.line_number) return false;
+        if (strncmp(ta.parent_line.line_buf, tb.parent_line.line_buf, MAX_LINE_BUF_SZ) != 0) return false;
+    }
+
+    for (size_t i = 0; i<a->num_children; i++)
+        if (!equalLexTree(a->children[i], b->children[i])) return false;
+
+    return true;
+}
@@ -49,5 +49,12 @@ void printLexNode(const LexNode node, const size_t level);
 void printLexTree(const LexNode node);
 
 const LexNode buildLexTree(FileLine file_as_lines[MAX_LINES_IN_FILE], const size_t num_lines);
+/* Applies edits to source in order and re-lexes only the smallest balanced region around them.
+ * Pass NULL as master_node to build from scratch. Stops at the first edit applySourceEdit rejects;
+ * *num_applied (if given) says how many went in, and the tree returned matches just those.
+ * Returns NULL if the edited source has mismatched braces; master_node is then left untouched
+ * but no longer matches source, so the next call should pass NULL. */
+const LexNode patchLexTree(LexNode master_node, SourceFile* source, const SourceEdit* edits, const size_t num_edits, size_t* num_applied);
+bool equalLexTree(const LexNode a, const LexNode b);
 
 #endif /* LEXER_H */
\ No newline at end of file
@@ -15,6 +15,7 @@
 #define ERROR_GENERIC 1
 #define ERROR_UNEXPECTED_COMPILER 2
 #define ERROR_MISMATCHED_BRACES 3
+#define ERROR_OUT_OF_MEMORY 4
 
 #include "debug.h"
 
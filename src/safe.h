@@ -2,7 +2,9 @@
 #define SAFE_H
 
 #include <stdlib.h>
-#define safeFree(X) if (X) free(X)
+#include "alloc.h"
+
+#define safeFree(X) if (X) poolFree(X)
 
 int safeExit(const int exit_code);
 
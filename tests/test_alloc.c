@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "alloc.h"
+#include "macros.h"
+#include "lexer.h"
+
+/* Globals that macc.c normally provides */
+Token* line_as_tokens = NULL;
+FileLine const* DebugLastFileLine = NULL;
+Token const*    DebugLastToken    = NULL;
+
+/* Lets a test catch the allocator bailing out instead of exiting */
+static jmp_buf exit_jump;
+static bool is_exit_expected = false;
+
+int safeExit(const int exit_code) {
+    if (is_exit_expected) longjmp(exit_jump, exit_code);
+    exit(exit_code);
+}
+
+/* Backend that tracks how many bytes it is holding */
+typedef union counted_block_u {
+    size_t size;
+    max_align_t align;
+} CountedBlock;
+
+static size_t backend_bytes = 0;
+static size_t backend_allocs = 0;
+
+static void* countingAlloc(size_t size) {
+    CountedBlock* block = (CountedBlock*)malloc(sizeof(CountedBlock) + size);
+    if (!block) return NULL;
+    block->size = size;
+    backend_bytes += size;
+    backend_allocs++;
+    return block + 1;
+}
+
+static void countingFree(void* ptr) {
+    CountedBlock* block = (CountedBlock*)ptr - 1;
+    backend_bytes -= block->size;
+    free(block);
+}
+
+static size_t num_failures = 0;
+
+static void report(const char* name, const bool passed) {
+    printf("[%s] %s\n", passed ? "PASS" : "FAIL", name);
+    if (!passed) num_failures++;
+}
+
+static void testRoundTrip() {
+    void* a = poolAlloc(AP_Reader, 100);
+    void* b = poolAlloc(AP_Reader, 50);
+    const bool is_live = poolLiveBytes(AP_Reader) == 150 && poolPeakBytes(AP_Reader) == 150 && reportLeaks();
+    poolFree(a);
+    poolFree(b);
+    report("Alloc/free round trip returns live bytes to 0",
+        is_live && poolLiveBytes(AP_Reader) == 0 && poolPeakBytes(AP_Reader) == 150 && !reportLeaks());
+}
+
+static void testReservedMatchesBackend() {
+    void* a = poolAlloc(AP_Lexer, 1000);
+    const bool is_held = reservedBytes() == backend_bytes && reservedBytes() > 1000;
+    poolFree(a);
+    report("Reserved bytes match the backend, headers included", is_held && reservedBytes() == backend_bytes);
+}
+
+static void testTreeBlockReuse() {
+    const size_t size = sizeof(struct lex_node_s);
+    void* a = poolAlloc(AP_Tree, size);
+    const size_t reserved = reservedBytes();
+    const size_t allocs = backend_allocs;
+
+    poolFree(a);
+    void* b = poolAlloc(AP_Tree, size);
+    report("Freed tree block is reused without reserving more",
+        a == b && reservedBytes() == reserved && backend_allocs == allocs && poolLiveBytes(AP_Tree) == size);
+
+    poolFree(b);
+    report("Cached tree blocks are not live", poolLiveBytes(AP_Tree) == 0 && reservedBytes() == backend_bytes);
+}
+
+static void testBudget() {
+    setMemoryBudget(reservedBytes() + 100);
+
+    int exit_code = 0;
+    is_exit_expected = true;
+    if (!(exit_code = setjmp(exit_jump))) poolAlloc(AP_Reader, 1000);
+    is_exit_expected = false;
+
+    report("Going over budget exits with ERROR_OUT_OF_MEMORY",
+        exit_code == ERROR_OUT_OF_MEMORY && poolLiveBytes(AP_Reader) == 0 && !DebugLastFileLine);
+
+    void* a = poolAlloc(AP_Reader, 10);
+    report("Allocations within budget still succeed", a && reservedBytes() == backend_bytes);
+    poolFree(a);
+
+    setMemoryBudget(0);
+}
+
+static void testParseByteSize() {
+    struct { const char* s; bool is_valid; size_t bytes; } cases[] = {
+        { "4096", true, 4096 },
+        { "512K", true, (size_t)512 << 10 },
+        { "64M" , true, (size_t)64  << 20 },
+        { "1g"  , true, (size_t)1   << 30 },
+        { "0"   , false }, { "0M", false },
+        { "-1"  , false }, { "+5", false }, { " 5", false },
+        { ""    , false }, { "M" , false }, { "12X", false }, { "64MB", false },
+        { "99999999999999999999999", false },
+        { "99999999999999G", false },
+    };
+
+    bool is_correct = true;
+    for (size_t i = 0; i<sizeof(cases)/sizeof(cases[0]); i++) {
+        size_t bytes = 0;
+        const bool is_valid = parseByteSize(cases[i].s, &bytes);
+        if (is_valid != cases[i].is_valid || (is_valid && bytes != cases[i].bytes)) {
+            printf("  parseByteSize(\"%s\") gave %d, %zu\n", cases[i].s, is_valid, bytes);
+            is_correct = false;
+        }
+    }
+    report("parseByteSize accepts sizes and rejects zero, signs, junk and overflow", is_correct);
+}
+
+int main() {
+    const Allocator counting_allocator = { .alloc = countingAlloc, .free = countingFree };
+    setAllocator(counting_allocator);
+
+    testRoundTrip();
+    testReservedMatchesBackend();
+    testTreeBlockReuse();
+    testBudget();
+    testParseByteSize();
+
+    printf("%zu failure(s)\n", num_failures);
+    return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
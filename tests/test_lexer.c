@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "file_reader.h"
+#include "lexer.h"
+
+/* Globals that macc.c normally provides */
+Token* line_as_tokens = NULL;
+FileLine const* DebugLastFileLine = NULL;
+Token const*    DebugLastToken    = NULL;
+
+int safeExit(const int exit_code) {
+    exit(exit_code);
+}
+
+static const char* base_text =
+    "#include <stdio.h>\n"
+    "\n"
+    "int add(int a, int b) {\n"
+    "    return a + b;\n"
+    "}\n"
+    "\n"
+    "int main() {\n"
+    "    // comment\n"
+    "    int x = add(1, 2);\n"
+    "    if (x == 3) {\n"
+    "        x++;\n"
+    "    }\n"
+    "\n"
+    "    return x;\n"
+    "}\n";
+
+static const char test_file_name[MAX_FILE_NAME_SZ] = "test.c";
+static char long_line[2*MAX_LINE_BUF_SZ];
+static SourceFile patched_source, fresh_source;
+static size_t num_failures = 0;
+
+static bool sameSource(const SourceFile* a, const SourceFile* b) {
+    if (a->num_lines != b->num_lines) return false;
+    for (size_t i = 0; i<a->num_lines; i++)
+        if (strcmp(a->raw_lines[i], b->raw_lines[i]) != 0) return false;
+    return true;
+}
+
+static bool matchesFreshBuild(const LexNode tree, const char* expected_text) {
+    loadSourceFile(&fresh_source, test_file_name, expected_text);
+    LexNode fresh_tree = buildLexTree(fresh_source.lines, fresh_source.num_lines);
+    const bool is_equal = equalLexTree(tree, fresh_tree) && sameSource(&patched_source, &fresh_source);
+    deleteLexTree(fresh_tree);
+    return is_equal;
+}
+
+static void report(const char* name, const bool passed) {
+    printf("[%s] %s\n", passed ? "PASS" : "FAIL", name);
+    if (!passed) num_failures++;
+}
+
+/* Patches a tree of from_text and checks it against a fresh build of expected_text */
+static void checkPatchFrom(const char* name, const char* from_text, const SourceEdit* edits, const size_t num_edits, const char* expected_text) {
+    loadSourceFile(&patched_source, test_file_name, from_text);
+    LexNode tree = buildLexTree(patched_source.lines, patched_source.num_lines);
+
+    size_t num_applied = 0;
+    LexNode patched_tree = patchLexTree(tree, &patched_source, edits, num_edits, &num_applied);
+    report(name, patched_tree == tree && num_applied == num_edits && matchesFreshBuild(patched_tree, expected_text));
+
+    deleteLexTree(patched_tree ? patched_tree : tree);
+}
+
+static void checkPatch(const char* name, const SourceEdit* edits, const size_t num_edits, const char* expected_text) {
+    checkPatchFrom(name, base_text, edits, num_edits, expected_text);
+}
+
+static void testReusesUntouchedNodes() {
+    loadSourceFile(&patched_source, test_file_name, base_text);
+    LexNode tree = buildLexTree(patched_source.lines, patched_source.num_lines);
+    const LexNode add_node    = tree->children[0];
+    const LexNode return_node = add_node->children[0];
+
+    const SourceEdit edit = newSourceEdit(10, 8, 10, 9, "y");
+    tree = patchLexTree(tree, &patched_source, &edit, 1, NULL);
+    report("Nodes outside the edited scope are reused", tree->children[0] == add_node && add_node->children[0] == return_node);
+
+    deleteLexTree(tree);
+}
+
+static const char* top_level_text =
+    "int g;\n"
+    "int f() {\n"
+    "    return g;\n"
+    "}\n"
+    "int h;\n"
+    "int k() {\n"
+    "    return h;\n"
+    "}\n";
+
+static void testReusesTopLevelSiblings() {
+    loadSourceFile(&patched_source, test_file_name, top_level_text);
+    LexNode tree = buildLexTree(patched_source.lines, patched_source.num_lines);
+    const LexNode f_node = tree->children[1];
+    const LexNode k_node = tree->children[3];
+
+    const SourceEdit edit = newSourceEdit(4, 4, 4, 5, "x");
+    tree = patchLexTree(tree, &patched_source, &edit, 1, NULL);
+    report("Edit on a top-level line reuses its siblings",
+        tree->children[1] == f_node && tree->children[3] == k_node &&
+        matchesFreshBuild(tree, "int g;\nint f() {\n    return g;\n}\nint x;\nint k() {\n    return h;\n}\n"));
+
+    deleteLexTree(tree);
+}
+
+static void testStopsAtRejectedEdit() {
+    const SourceEdit edits[] = {
+        newSourceEdit(10, 8, 10, 9, "y"),
+        newSourceEdit(99, 0, 99, 1, "x"),
+        newSourceEdit(13, 4, 13, 10, "break")
+    };
+    const SourceEdit bad_edits[] = { newSourceEdit(3, 50, 3, 51, "x"), newSourceEdit(4, 1, 3, 0, "x"), newSourceEdit(0, 0, 0, 0, long_line) };
+
+    loadSourceFile(&patched_source, test_file_name, base_text);
+    LexNode tree = buildLexTree(patched_source.lines, patched_source.num_lines);
+
+    size_t num_applied = 0;
+    tree = patchLexTree(tree, &patched_source, edits, 3, &num_applied);
+    report("Edits stop at the first rejected one", tree && num_applied == 1 && matchesFreshBuild(tree,
+        "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // comment\n"
+        "    int x = add(1, 2);\n    if (x == 3) {\n        y++;\n    }\n\n    return x;\n}\n"));
+
+    bool all_rejected = true;
+    for (size_t i = 0; i<3; i++) {
+        tree = patchLexTree(tree, &patched_source, &bad_edits[i], 1, &num_applied);
+        all_rejected = all_rejected && tree && num_applied == 0;
+    }
+    report("Out-of-range and oversized edits are rejected", all_rejected);
+
+    deleteLexTree(tree);
+}
+
+static void testLongPaste() {
+    /* Well past any fixed-size copy of the edit text */
+    static char paste[2048], expected_text[4096];
+    paste[0] = 0;
+    while (strlen(paste) + 10 < sizeof(paste)) strcat(paste, "    x--;\n");
+
+    const int blank_line_offset = (int)(strstr(base_text, "    }\n") - base_text) + 6;
+    snprintf(expected_text, sizeof(expected_text), "%.*s%s%s", blank_line_offset, base_text, paste, base_text + blank_line_offset);
+    const SourceEdit edits[] = { newSourceEdit(12, 0, 12, 0, paste) };
+    checkPatch("Paste more than 1KB of text", edits, 1, expected_text);
+}
+
+static void testUnbalancedKeepsOldTree() {
+    loadSourceFile(&patched_source, test_file_name, base_text);
+    LexNode tree = buildLexTree(patched_source.lines, patched_source.num_lines);
+
+    const SourceEdit stray_brace = newSourceEdit(1, 0, 1, 0, "}");
+    const LexNode failed_tree = patchLexTree(tree, &patched_source, &stray_brace, 1, NULL);
+
+    /* The old tree must still describe base_text */
+    static SourceFile base_source;
+    loadSourceFile(&base_source, test_file_name, base_text);
+    LexNode base_tree = buildLexTree(base_source.lines, base_source.num_lines);
+    report("Stray top-level `}` returns NULL and keeps the old tree", !failed_tree && equalLexTree(tree, base_tree));
+    deleteLexTree(base_tree);
+    deleteLexTree(tree);
+
+    const SourceEdit remove_brace = newSourceEdit(1, 0, 1, 1, "");
+    tree = patchLexTree(NULL, &patched_source, &remove_brace, 1, NULL);
+    report("Patching from NULL rebuilds once braces balance again", tree && matchesFreshBuild(tree, base_text));
+    if (tree) deleteLexTree(tree);
+}
+
+int main() {
+    memset(long_line, 'x', sizeof(long_line)-1);
+
+    {
+        const SourceEdit edits[] = { newSourceEdit(10, 8, 10, 9, "y") };
+        checkPatch("In-place token edit", edits, 1,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // comment\n"
+            "    int x = add(1, 2);\n    if (x == 3) {\n        y++;\n    }\n\n    return x;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(10, 0, 10, 0, "        {\n"), newSourceEdit(12, 0, 12, 0, "        }\n") };
+        checkPatch("Add a balanced inner block", edits, 2,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // comment\n"
+            "    int x = add(1, 2);\n    if (x == 3) {\n        {\n        x++;\n        }\n    }\n\n    return x;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(8, 21, 8, 22, " {") };
+        checkPatch("Add an unbalanced `{`", edits, 1,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // comment\n"
+            "    int x = add(1, 2) {\n    if (x == 3) {\n        x++;\n    }\n\n    return x;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(11, 4, 11, 5, "") };
+        checkPatch("Remove a `}`", edits, 1,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // comment\n"
+            "    int x = add(1, 2);\n    if (x == 3) {\n        x++;\n    \n\n    return x;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(13, 0, 13, 13, "") };
+        checkPatch("Empty a line", edits, 1,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // comment\n"
+            "    int x = add(1, 2);\n    if (x == 3) {\n        x++;\n    }\n\n\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(9, 4, 9, 4, "//"), newSourceEdit(11, 4, 11, 4, "//") };
+        checkPatch("Comment out a block's braces", edits, 2,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // comment\n"
+            "    int x = add(1, 2);\n    //if (x == 3) {\n        x++;\n    //}\n\n    return x;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(7, 7, 7, 7, "more "), newSourceEdit(12, 0, 12, 0, "    x--;") };
+        checkPatch("Edit inside a comment and type on a blank line", edits, 2,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;\n}\n\nint main() {\n    // more comment\n"
+            "    int x = add(1, 2);\n    if (x == 3) {\n        x++;\n    }\n    x--;\n    return x;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(9, 16, 9, 16, "\n   "), newSourceEdit(3, 17, 4, 0, "") };
+        checkPatch("Split and join lines", edits, 2,
+            "#include <stdio.h>\n\nint add(int a, int b) {\n    return a + b;}\n\nint main() {\n    // comment\n"
+            "    int x = add(1, 2);\n    if (x == 3) \n   {\n        x++;\n    }\n\n    return x;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(3, 0, 3, 1, "") };
+        checkPatchFrom("Remove a function's closing `}`", top_level_text, edits, 1,
+            "int g;\nint f() {\n    return g;\n\nint h;\nint k() {\n    return h;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(0, 5, 0, 6, " {") };
+        checkPatchFrom("Open a scope on a top-level line", top_level_text, edits, 1,
+            "int g {\nint f() {\n    return g;\n}\nint h;\nint k() {\n    return h;\n}\n");
+    }
+    {
+        const SourceEdit edits[] = { newSourceEdit(1, 9, 1, 9, "\n\n") };
+        checkPatchFrom("Split a function's `{` line", top_level_text, edits, 1,
+            "int g;\nint f() {\n\n\n    return g;\n}\nint h;\nint k() {\n    return h;\n}\n");
+    }
+
+    testReusesUntouchedNodes();
+    testReusesTopLevelSiblings();
+    testStopsAtRejectedEdit();
+    testLongPaste();
+    testUnbalancedKeepsOldTree();
+
+    printf("%zu failure(s)\n", num_failures);
+    return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}